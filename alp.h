@@ -12,6 +12,9 @@
 #define ALP_NODE_PORT   5001
 #define MAX_PACKET_SIZE 512  // Ograniczenie bufora Arduino (EBSim)
 
+// Co ile węzeł wysyła HEARTBEAT (serwer wykrywa na tej podstawie awarie)
+#define ALP_HEARTBEAT_INTERVAL_MS 1000
+
 // Typy wiadomości (Message Types)
 #define MSG_REGISTER      0x01
 #define MSG_CONFIG        0x02
@@ -23,17 +26,30 @@
 #define MSG_UPLOAD        0x08
 #define MSG_ACK           0x09
 #define MSG_ERROR         0x0A
+#define MSG_HANDOVER_NOTIFY 0x0B
+#define MSG_HEARTBEAT     0x0C
 
 // Kierunki wyjścia (dla Handover)
 #define DIR_NORTH 0
 #define DIR_EAST  1
 #define DIR_SOUTH 2
 #define DIR_WEST  3
+#define DIR_COUNT 4
+#define DIR_NONE  0xFF // Brak kierunku wyjścia (stan żółwia ze START / HEARTBEAT)
+
+// Brak sąsiada / nieznany węzeł
+#define NODE_ID_NONE 0xFF
 
 // Kody błędów
 #define ERR_UNKNOWN_TYPE  0x01
 #define ERR_BUFFER_OF     0x02 // Buffer overflow
 #define ERR_OUT_OF_BOUNDS 0x03
+#define ERR_EVICTED       0x04 // Serwer uznał węzeł za martwy/zawieszony - zarejestruj się ponownie
+
+// Stan węzła (w HEARTBEAT)
+#define NODE_STATE_IDLE     0
+#define NODE_STATE_DRAWING  1
+#define NODE_STATE_FINISHED 2
 
 /* ==========================================
    STRUKTURY DANYCH
@@ -55,8 +71,15 @@ typedef struct {
     uint16_t node_port;
 } PayloadRegister;
 
+// Adres sąsiedniego węzła (część CONFIG)
+typedef struct {
+    uint8_t node_id;    // NODE_ID_NONE jeśli brak sąsiada w tym kierunku
+    uint8_t ip[4];      // Adres IPv4, bajt po bajcie (a.b.c.d)
+    uint16_t port;      // NETWORK BYTE ORDER!
+} NeighbourInfo;
+
 // 3. Payload: CONFIG (0x02)
-// Server -> Node: "To jest twój obszar rysowania"
+// Server -> Node: "To jest twój obszar rysowania i twoi sąsiedzi"
 typedef struct {
     uint8_t node_id;
     uint8_t step_size;  // Długość kreski (d)
@@ -65,6 +88,8 @@ typedef struct {
     uint16_t x_max;
     uint16_t y_min;
     uint16_t y_max;
+    NeighbourInfo neighbours[DIR_COUNT]; // Indeksowane kierunkiem wyjścia (DIR_*)
+    uint16_t epoch;     // Wersja przydziału obszarów - rośnie przy każdej zmianie (NETWORK BYTE ORDER!)
 } PayloadConfig;
 
 // 4. Payload: REQUEST_CHUNK (0x04)
@@ -100,7 +125,8 @@ typedef struct {
 } TurtleStackItem;
 
 // 7. Payload: HANDOVER (0x06)
-// Node -> Server: "Żółw wyszedł poza mój obszar, przekaż go dalej"
+// Node -> Node (Target): "Przejmij żółwia" (bezpośrednio, gdy sąsiad znany z CONFIG)
+// Node -> Server: "Żółw wyszedł poza mój obszar, przekaż go dalej" (sąsiad nieznany)
 // Server -> Node (Target): "Przejmij żółwia"
 typedef struct {
     uint8_t target_node_id; // Kto ma przejąć (lub 0xFF jeśli nieznany)
@@ -115,6 +141,7 @@ typedef struct {
 
 // 8. Payload: DONE (0x07)
 // Node -> Server: "Skończyłem rysować (koniec stringa)"
+// Server -> Node: "Render zakończony, wyślij swoją bitmapę (UPLOAD)" (bez payloadu)
 typedef struct {
     uint8_t node_id;
     uint32_t total_steps; // Statystyka: ile kroków narysowano (NETWORK BYTE ORDER!)
@@ -147,6 +174,20 @@ typedef struct {
     char message[];     // Opcjonalny opis tekstowy
 } PayloadError;
 
+// 12. Payload: HANDOVER_NOTIFY (0x0B)
+// Node -> Server: "Przekazałem żółwia bezpośrednio sąsiadowi" (tylko do statystyk)
+// Treść identyczna jak PayloadHandover (target_node_id ustawiony przez nadawcę)
+
+// 13. Payload: HEARTBEAT (0x0C)
+// Node -> Server: "Żyję" (co ALP_HEARTBEAT_INTERVAL_MS)
+// Gdy state == NODE_STATE_DRAWING, dalej następuje PayloadHandover ze stanem żółwia
+// (punkt kontrolny - serwer przekaże go innemu węzłowi, jeśli ten padnie)
+typedef struct {
+    uint8_t node_id;
+    uint8_t state;      // NODE_STATE_*
+    uint16_t epoch;     // Wersja ostatniego CONFIG - nieaktualna = serwer wysyła CONFIG ponownie
+} PayloadHeartbeat;
+
 #pragma pack(pop)
 
 /* ==========================================
@@ -0,0 +1,349 @@
+// ==========================================
+// MIKROBENCHMARKI (HOST / LINUX)
+// ==========================================
+// Kompiluje kluczowe funkcje server.c i node.ino na hosta i mierzy je osobno:
+//   load_lsystem, generate_lsystem, REQUEST_CHUNK -> STRING_CHUNK,
+//   pętla składania UPLOAD, processChunk/drawLine (żółw z node.ino).
+//
+// Kompilacja (z katalogu głównego repo):
+//   g++ -O2 -I bench/shim -o bench_lsys bench/bench.cpp
+// Uruchomienie:
+//   ./bench_lsys                   # wszystkie dołączone definicje
+//   ./bench_lsys koch.txt plant.txt
+//
+// Wyniki: przepustowość (symbole/s, piksele/s) oraz liczba alokacji na operację.
+// printf w server.c i Serial w node.ino są wyłączone na etapie kompilacji,
+// więc pomiar nie obejmuje formatowania logów.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Serwer: sendto() nic nie wysyła, main() nie koliduje z main() benchmarku.
+// printf -> martwy kod: argumenty nie są liczone, brak ostrzeżeń o nieużywanych zmiennych.
+#define sendto bench_sendto
+#define main server_main
+#define printf(...) do { if (0) printf(__VA_ARGS__); } while (0)
+#include "../server.c"
+#undef printf
+#undef main
+#undef sendto
+
+// Węzeł: Arduino API z bench/shim
+#include "../node.ino"
+
+#ifndef BENCH_MIN_SEC
+#define BENCH_MIN_SEC 0.2    // Minimalny czas jednego pomiaru
+#endif
+
+#define BENCH_EXTRA_ITERATIONS 2  // Generator: iteracje z pliku + 0..N dodatkowych
+
+/* ==========================================
+   ZAŚLEPKA sendto() I LICZNIK ALOKACJI
+   ========================================== */
+
+// noinline + bariera: kompilator nie może usunąć budowy pakietu (memcpy chunka)
+extern "C" __attribute__((noinline))
+ssize_t bench_sendto(int, const void *buf, size_t len, int,
+                     const struct sockaddr *, socklen_t) {
+    asm volatile("" : : "r"(buf) : "memory");
+    return (ssize_t)len;
+}
+
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t n, size_t size);
+extern "C" void *__libc_realloc(void *ptr, size_t size);
+extern "C" void __libc_free(void *ptr);
+
+static unsigned long alloc_count = 0;
+
+extern "C" void *malloc(size_t size) {
+    alloc_count++;
+    return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t n, size_t size) {
+    alloc_count++;
+    return __libc_calloc(n, size);
+}
+
+extern "C" void *realloc(void *ptr, size_t size) {
+    alloc_count++;
+    return __libc_realloc(ptr, size);
+}
+
+extern "C" void free(void *ptr) {
+    __libc_free(ptr);
+}
+
+/* ==========================================
+   NARZĘDZIA POMIARU
+   ========================================== */
+
+static double now_sec() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+typedef void (*BenchFn)(void *ctx);
+
+typedef struct {
+    unsigned long reps;
+    double elapsed;
+    double allocs_per_op;
+} BenchResult;
+
+// Uruchamiaj fn z podwajaną liczbą powtórzeń aż pomiar trwa >= BENCH_MIN_SEC
+static BenchResult run_bench(BenchFn fn, void *ctx) {
+    BenchResult r;
+    unsigned long reps = 1;
+
+    fn(ctx);  // Rozgrzewka
+
+    while (1) {
+        unsigned long allocs_before = alloc_count;
+        double t0 = now_sec();
+        for (unsigned long i = 0; i < reps; i++) {
+            fn(ctx);
+        }
+        double elapsed = now_sec() - t0;
+
+        if (elapsed >= BENCH_MIN_SEC || reps >= (1UL << 30)) {
+            r.reps = reps;
+            r.elapsed = elapsed;
+            r.allocs_per_op = (double)(alloc_count - allocs_before) / reps;
+            break;
+        }
+        reps *= 2;
+    }
+    return r;
+}
+
+static void report(const char *file, const char *stage, const BenchResult *r,
+                   double units_per_op, const char *unit) {
+    double rate = units_per_op * r->reps / r->elapsed;
+    double ns_per_op = r->elapsed * 1e9 / r->reps;
+    printf("%-16s %-28s %14.0f %-10s %12.0f ns/op %8.2f allocs/op\n",
+           file, stage, rate, unit, ns_per_op, r->allocs_per_op);
+}
+
+/* ==========================================
+   BENCHMARKI: SERWER
+   ========================================== */
+
+static void bench_load(void *ctx) {
+    load_lsystem((const char *)ctx);
+}
+
+static void bench_generate(void *) {
+    generate_lsystem();
+}
+
+// Wszystkie REQUEST_CHUNK potrzebne do przejścia całego stringa (max_len jak w node.ino)
+static void bench_request_chunk(void *) {
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+
+    PayloadRequestChunk req;
+    req.max_len = htons(100);
+
+    for (uint32_t offset = 0; offset <= l_system_len; offset += 100) {
+        req.offset = htonl(offset);
+        handle_request_chunk(0, &addr, (uint8_t *)&req);
+    }
+}
+
+typedef struct {
+    int count;
+    uint8_t *packets[SHIM_CAPTURE_MAX];
+} UploadCtx;
+
+static void bench_upload(void *ctx) {
+    UploadCtx *uc = (UploadCtx *)ctx;
+    for (int i = 0; i < uc->count; i++) {
+        handle_upload(0, uc->packets[i] + sizeof(ALPHeader));
+    }
+    nodes[0].fragments_received = 0;
+}
+
+/* ==========================================
+   BENCHMARKI: WĘZEŁ (ŻÓŁW)
+   ========================================== */
+
+static unsigned long turtle_handovers = 0;
+
+// Konfiguracja jak Node 2 (start renderu), kąt z definicji L-systemu
+static void node_reset() {
+    area_x_min = 0;
+    area_x_max = NODE_BITMAP_W;
+    area_y_min = 0;
+    area_y_max = NODE_BITMAP_H;
+    step_size = 2;
+    turn_angle = lsystem.angle;
+    for (uint8_t dir = 0; dir < DIR_COUNT; dir++) {
+        neighbours[dir].node_id = NODE_ID_NONE;
+    }
+
+    t_x = 5;
+    t_y = 5;
+    t_angle = 0;
+    string_pos = 0;
+    stack_depth = 0;
+    total_string_len = 0;  // Koniec stringa nie wywoła sendDone()/sendUpload() (osobny etap)
+    total_steps_drawn = 0;
+    clearBitmap();
+
+    isConfigured = true;
+    isDrawing = true;
+    isFinished = false;
+}
+
+// Cały string przez processChunk, paczkami po 100 symboli (jak z serwera).
+// Gdy żółw opuści obszar, wraca na środek - pętla interpretera pracuje dalej.
+static void bench_turtle(void *) {
+    node_reset();
+    turtle_handovers = 0;
+
+    while (string_pos < l_system_len) {
+        if (!isDrawing) {
+            t_x = NODE_BITMAP_W / 2;
+            t_y = NODE_BITMAP_H / 2;
+            isDrawing = true;
+            turtle_handovers++;
+        }
+        uint32_t len = l_system_len - string_pos;
+        if (len > 100) len = 100;
+        processChunk(&l_system_string[string_pos], (uint16_t)len);
+    }
+}
+
+// Koniec renderu: DONE + bitmapa we fragmentach
+static void bench_finish(void *) {
+    sendDone();
+    sendUpload();
+}
+
+#define DRAWLINE_COUNT 64
+
+typedef struct {
+    int x1[DRAWLINE_COUNT];
+    int y1[DRAWLINE_COUNT];
+    unsigned long pixels;  // Suma pikseli wszystkich odcinków (Bresenham: max(|dx|,|dy|) + 1)
+} DrawLineCtx;
+
+static void bench_drawline(void *ctx) {
+    DrawLineCtx *dc = (DrawLineCtx *)ctx;
+    for (int i = 0; i < DRAWLINE_COUNT; i++) {
+        drawLine(BITMAP_W / 2, BITMAP_H / 2, dc->x1[i], dc->y1[i]);
+    }
+}
+
+/* ==========================================
+   MAIN
+   ========================================== */
+
+static void bench_file(const char *path) {
+    BenchResult r;
+    char stage[64];
+
+    // load_lsystem
+    r = run_bench(bench_load, (void *)path);
+    report(path, "load_lsystem", &r, 1, "loads/s");
+
+    // generate_lsystem dla rosnącej liczby iteracji
+    int base_iterations = lsystem.iterations;
+    for (int extra = 0; extra <= BENCH_EXTRA_ITERATIONS; extra++) {
+        lsystem.iterations = base_iterations + extra;
+        r = run_bench(bench_generate, NULL);
+        snprintf(stage, sizeof(stage), "generate_lsystem it=%d%s", lsystem.iterations,
+                 (l_system_len > L_SYSTEM_MAX_LEN - MAX_RULE_LEN) ? "*" : "");
+        report(path, stage, &r, l_system_len, "sym/s");
+    }
+
+    // Dalsze etapy na stringu z pliku (bez dodatkowych iteracji)
+    lsystem.iterations = base_iterations;
+    generate_lsystem();
+
+    // REQUEST_CHUNK -> STRING_CHUNK
+    r = run_bench(bench_request_chunk, NULL);
+    report(path, "request_chunk", &r, l_system_len, "sym/s");
+
+    // processChunk (żółw)
+    r = run_bench(bench_turtle, NULL);
+    report(path, "processChunk", &r, l_system_len, "sym/s");
+    printf("%-16s %-28s %14.0f %-10s (handovers/op: %lu, lines/op: %u)\n",
+           path, "processChunk", (double)total_steps_drawn * r.reps / r.elapsed, "lines/s",
+           turtle_handovers, total_steps_drawn);
+
+    // sendDone + sendUpload (bitmapa po przebiegu żółwia)
+    r = run_bench(bench_finish, NULL);
+    report(path, "sendDone+sendUpload", &r, BITMAP_W * BITMAP_H, "px/s");
+
+    // UPLOAD: fragmenty z sendUpload() po przebiegu żółwia, składane przez serwer
+    Udp.captured_count = 0;
+    Udp.capture = true;
+    sendUpload();
+    Udp.capture = false;
+
+    UploadCtx uc;
+    uc.count = Udp.captured_count;
+    unsigned long pixels = 0;
+    for (int i = 0; i < uc.count; i++) {
+        uc.packets[i] = Udp.captured[i];
+        PayloadUpload *up = (PayloadUpload *)(uc.packets[i] + sizeof(ALPHeader));
+        pixels += (unsigned long)ntohs(up->row_count) * up->total_width;
+    }
+
+    memset(nodes, 0, sizeof(nodes));
+    nodes[0].active = 1;
+    assign_region(0);
+
+    r = run_bench(bench_upload, &uc);
+    report(path, "upload_composite", &r, pixels, "px/s");
+}
+
+int main(int argc, char *argv[]) {
+    static const char *default_files[] = {
+        "square.txt", "koch.txt", "dragon.txt", "sierpinski.txt", "plant.txt"
+    };
+    const char **files = default_files;
+    int file_count = sizeof(default_files) / sizeof(default_files[0]);
+
+    if (argc > 1) {
+        files = (const char **)&argv[1];
+        file_count = argc - 1;
+    }
+
+    printf("%-16s %-28s %14s %-10s %18s %18s\n",
+           "file", "stage", "throughput", "unit", "time", "allocations");
+
+    for (int i = 0; i < file_count; i++) {
+        int rc = load_lsystem(files[i]);
+        if (rc < 0) {
+            fprintf(stderr, "[BENCH] Cannot load %s, skipping\n", files[i]);
+            continue;
+        }
+        bench_file(files[i]);
+    }
+
+    // drawLine: odcinki ze środka bitmapy do punktów na okręgu
+    DrawLineCtx dc;
+    dc.pixels = 0;
+    area_x_min = 0;
+    area_y_min = 0;
+    for (int i = 0; i < DRAWLINE_COUNT; i++) {
+        double a = 2.0 * 3.14159265 * i / DRAWLINE_COUNT;
+        dc.x1[i] = BITMAP_W / 2 + (int)lround(7.0 * cos(a));
+        dc.y1[i] = BITMAP_H / 2 + (int)lround(7.0 * sin(a));
+        int dx = abs(dc.x1[i] - BITMAP_W / 2);
+        int dy = abs(dc.y1[i] - BITMAP_H / 2);
+        dc.pixels += (dx > dy ? dx : dy) + 1;
+    }
+    BenchResult r = run_bench(bench_drawline, &dc);
+    report("-", "drawLine", &r, dc.pixels, "px/s");
+
+    printf("\n* = string obcięty do L_SYSTEM_MAX_LEN\n");
+    return 0;
+}
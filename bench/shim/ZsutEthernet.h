@@ -0,0 +1,62 @@
+#ifndef ZSUT_ETHERNET_HOST_SHIM_H
+#define ZSUT_ETHERNET_HOST_SHIM_H
+
+/* ==========================================
+   HOST SHIM: Arduino + ZsutEthernet (tylko dla bench/)
+   ==========================================
+   Minimalne zamienniki API Arduino, żeby node.ino skompilował się na Linuksie.
+   Serial jest niemy (wyjście odrzucane), delay() nic nie robi. */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+typedef uint8_t byte;
+
+#define F(s) (s)
+#define HEX 16
+
+inline void delay(unsigned long) {}
+
+inline unsigned long millis() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long)ts.tv_sec * 1000UL + ts.tv_nsec / 1000000UL;
+}
+
+class HostSerial {
+public:
+    void begin(unsigned long) {}
+    template <typename T> void print(const T &) {}
+    template <typename T> void print(const T &, int) {}
+    template <typename T> void println(const T &) {}
+    template <typename T> void println(const T &, int) {}
+    void println() {}
+};
+
+static HostSerial Serial;
+
+class ZsutIPAddress {
+public:
+    uint8_t octets[4];
+
+    ZsutIPAddress() { memset(octets, 0, sizeof(octets)); }
+    ZsutIPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) {
+        octets[0] = a; octets[1] = b; octets[2] = c; octets[3] = d;
+    }
+
+    uint8_t operator[](int i) const { return octets[i]; }
+    bool operator==(const ZsutIPAddress &o) const { return memcmp(octets, o.octets, 4) == 0; }
+};
+
+class ZsutEthernetClass {
+public:
+    void begin(const uint8_t *) {}
+    ZsutIPAddress localIP() { return ZsutIPAddress(127, 0, 0, 1); }
+};
+
+static ZsutEthernetClass ZsutEthernet;
+
+#endif // ZSUT_ETHERNET_HOST_SHIM_H
@@ -0,0 +1,55 @@
+#ifndef ZSUT_ETHERNET_UDP_HOST_SHIM_H
+#define ZSUT_ETHERNET_UDP_HOST_SHIM_H
+
+/* ==========================================
+   HOST SHIM: ZsutEthernetUDP (tylko dla bench/)
+   ==========================================
+   Nic nie wysyła (ale dane pakietu są "konsumowane"). Zlicza pakiety/bajty i opcjonalnie zapamiętuje
+   ostatnie pakiety (capture), żeby benchmark mógł je odtworzyć po stronie serwera. */
+
+#include "ZsutEthernet.h"
+
+#define SHIM_CAPTURE_MAX 8
+#define SHIM_PACKET_MAX  512
+
+class ZsutEthernetUDP {
+public:
+    unsigned long packets_sent;
+    unsigned long bytes_sent;
+
+    bool capture;
+    int captured_count;
+    uint16_t captured_len[SHIM_CAPTURE_MAX];
+    uint8_t captured[SHIM_CAPTURE_MAX][SHIM_PACKET_MAX];
+
+    ZsutEthernetUDP() : packets_sent(0), bytes_sent(0), capture(false), captured_count(0), pending_len(0) {}
+
+    void begin(unsigned int) {}
+    int parsePacket() { return 0; }
+    int read(uint8_t *, int) { return 0; }
+    ZsutIPAddress remoteIP() { return ZsutIPAddress(); }
+    unsigned int remotePort() { return 0; }
+
+    void beginPacket(const ZsutIPAddress &, unsigned int) { pending_len = 0; }
+
+    void write(const uint8_t *data, size_t len) {
+        asm volatile("" : : "r"(data) : "memory");  // Pakiet "wysłany" - kompilator nie usunie jego budowy
+        if (capture && captured_count < SHIM_CAPTURE_MAX && len <= SHIM_PACKET_MAX) {
+            memcpy(captured[captured_count], data, len);
+            pending_len = (uint16_t)len;
+        }
+        bytes_sent += len;
+    }
+
+    void endPacket() {
+        if (capture && captured_count < SHIM_CAPTURE_MAX && pending_len > 0) {
+            captured_len[captured_count++] = pending_len;
+        }
+        packets_sent++;
+    }
+
+private:
+    uint16_t pending_len;
+};
+
+#endif // ZSUT_ETHERNET_UDP_HOST_SHIM_H
@@ -33,6 +33,10 @@ uint16_t area_y_min, area_y_max;
 uint8_t step_size = 5;
 uint16_t turn_angle = 90;
 
+// Sąsiedzi (z CONFIG) - HANDOVER wysyłany bezpośrednio, bez pośrednictwa serwera
+NeighbourInfo neighbours[DIR_COUNT];
+uint16_t configEpoch = 0;  // Wersja ostatniego CONFIG (odsyłana w HEARTBEAT)
+
 // Stan Żółwia
 float t_x, t_y;
 int16_t t_angle;
@@ -69,6 +73,25 @@ uint32_t my_htonl(uint32_t v) {
 }
 uint32_t my_ntohl(uint32_t v) { return my_htonl(v); }
 
+// HANDOVER przyjmujemy tylko od serwera lub od sąsiada z bieżącego CONFIG.
+// Wyrzucony węzeł znika z tablicy sąsiadów, więc jego spóźniony żółw jest odrzucany.
+bool isTrustedSender() {
+    ZsutIPAddress ip = Udp.remoteIP();
+    unsigned int port = Udp.remotePort();
+    
+    if (ip == serverIP && port == serverPort) return true;
+    
+    for (uint8_t dir = 0; dir < DIR_COUNT; dir++) {
+        NeighbourInfo *nb = &neighbours[dir];
+        if (nb->node_id == NODE_ID_NONE) continue;
+        if (ip[0] == nb->ip[0] && ip[1] == nb->ip[1] && ip[2] == nb->ip[2] && ip[3] == nb->ip[3] &&
+            port == my_ntohs(nb->port)) {
+            return true;
+        }
+    }
+    return false;
+}
+
 // ==========================================
 // FUNKCJE BITMAPY
 // ==========================================
@@ -118,23 +141,27 @@ void drawLine(int x0, int y0, int x1, int y1) {
 // LOGIKA WYSYŁANIA
 // ==========================================
 
-void sendPacket(uint8_t type, void* payload, uint16_t payload_len) {
-    memset(packetBuffer, 0, MAX_PACKET_SIZE);
+void sendPacketTo(ZsutIPAddress ip, unsigned int port, uint8_t type, void* payload, uint16_t payload_len) {
+    // Payload może leżeć w samym packetBuffer (sendUpload) - najpierw przesuń go
+    // za nagłówek (memmove), dopiero potem zapisz nagłówek. Bez memset: zerowałby payload.
+    if (payload_len > 0 && payload != NULL) {
+        memmove(packetBuffer + sizeof(ALPHeader), payload, payload_len);
+    }
     
     ALPHeader *h = (ALPHeader *)packetBuffer;
     h->type = type;
     h->seq_no = mySeqNo++;
     h->length = my_htons(payload_len);
     
-    if (payload_len > 0 && payload != NULL) {
-        memcpy(packetBuffer + sizeof(ALPHeader), payload, payload_len);
-    }
-    
-    Udp.beginPacket(serverIP, serverPort);
+    Udp.beginPacket(ip, port);
     Udp.write(packetBuffer, sizeof(ALPHeader) + payload_len);
     Udp.endPacket();
 }
 
+void sendPacket(uint8_t type, void* payload, uint16_t payload_len) {
+    sendPacketTo(serverIP, serverPort, type, payload, payload_len);
+}
+
 void sendRegister() {
     PayloadRegister p;
     p.node_port = my_htons(localPort);
@@ -152,15 +179,13 @@ void requestChunk(uint32_t offset) {
     Serial.println(offset);
 }
 
-void sendHandover(uint8_t dir) {
+// Zapisz stan żółwia (pozycja, kąt, stos) jako PayloadHandover. Zwraca długość.
+uint16_t packTurtleState(uint8_t *buf) {
     uint16_t stack_bytes = stack_depth * sizeof(TurtleStackItem);
-    uint16_t total_payload_len = sizeof(PayloadHandover) + stack_bytes;
-    
-    uint8_t tempBuf[MAX_PACKET_SIZE];
-    PayloadHandover *ph = (PayloadHandover *)tempBuf;
+    PayloadHandover *ph = (PayloadHandover *)buf;
     
     ph->target_node_id = 0xFF;
-    ph->exit_dir = dir;
+    ph->exit_dir = DIR_NONE;
     ph->string_pos = my_htonl(string_pos);
     ph->current_x = my_htons((uint16_t)t_x);
     ph->current_y = my_htons((uint16_t)t_y);
@@ -168,7 +193,7 @@ void sendHandover(uint8_t dir) {
     ph->stack_depth = my_htons(stack_depth);
     
     if (stack_depth > 0) {
-        TurtleStackItem *destStack = (TurtleStackItem *)(tempBuf + sizeof(PayloadHandover));
+        TurtleStackItem *destStack = (TurtleStackItem *)(buf + sizeof(PayloadHandover));
         for (uint16_t i = 0; i < stack_depth; i++) {
             destStack[i].x = my_htons(stack[i].x);
             destStack[i].y = my_htons(stack[i].y);
@@ -176,16 +201,57 @@ void sendHandover(uint8_t dir) {
         }
     }
     
-    sendPacket(MSG_HANDOVER, tempBuf, total_payload_len);
+    return sizeof(PayloadHandover) + stack_bytes;
+}
+
+void sendHandover(uint8_t dir) {
+    uint8_t tempBuf[MAX_PACKET_SIZE];
+    PayloadHandover *ph = (PayloadHandover *)tempBuf;
+    uint16_t total_payload_len = packTurtleState(tempBuf);
+    ph->exit_dir = dir;
+    
+    NeighbourInfo *nb = &neighbours[dir];
+    if (nb->node_id != NODE_ID_NONE) {
+        // Sąsiad znany - wysyłamy bezpośrednio, serwer dostaje tylko powiadomienie
+        ph->target_node_id = nb->node_id;
+        ZsutIPAddress nbIP(nb->ip[0], nb->ip[1], nb->ip[2], nb->ip[3]);
+        sendPacketTo(nbIP, my_ntohs(nb->port), MSG_HANDOVER, tempBuf, total_payload_len);
+        sendPacket(MSG_HANDOVER_NOTIFY, tempBuf, total_payload_len);
+    } else {
+        sendPacket(MSG_HANDOVER, tempBuf, total_payload_len);
+    }
     
     Serial.print(F("[NODE] Sent HANDOVER. Dir: "));
     Serial.print(dir);
+    Serial.print(F(" to: "));
+    Serial.print(ph->target_node_id);
     Serial.print(F(" at pos: "));
     Serial.println(string_pos);
     
     isDrawing = false;
 }
 
+// HEARTBEAT: "żyję" + punkt kontrolny żółwia, jeśli właśnie rysujemy
+void sendHeartbeat() {
+    uint8_t tempBuf[sizeof(PayloadHeartbeat) + sizeof(PayloadHandover) +
+                    MAX_STACK_DEPTH * sizeof(TurtleStackItem)];
+    PayloadHeartbeat *hb = (PayloadHeartbeat *)tempBuf;
+    uint16_t payload_len = sizeof(PayloadHeartbeat);
+    
+    hb->node_id = myNodeId;
+    hb->epoch = my_htons(configEpoch);
+    if (isDrawing) {
+        hb->state = NODE_STATE_DRAWING;
+        payload_len += packTurtleState(tempBuf + sizeof(PayloadHeartbeat));
+    } else if (isFinished) {
+        hb->state = NODE_STATE_FINISHED;
+    } else {
+        hb->state = NODE_STATE_IDLE;
+    }
+    
+    sendPacket(MSG_HEARTBEAT, tempBuf, payload_len);
+}
+
 void sendDone() {
     PayloadDone pd;
     pd.node_id = myNodeId;
@@ -287,7 +353,7 @@ void processChunk(char* data, uint16_t len) {
                 float new_x = t_x + dx;
                 float new_y = t_y + dy;
 
-                uint8_t exit_dir = 0xFF;
+                uint8_t exit_dir = DIR_NONE;
                 
                 if (new_x < area_x_min) {
                     exit_dir = DIR_WEST;
@@ -299,7 +365,7 @@ void processChunk(char* data, uint16_t len) {
                     exit_dir = DIR_NORTH;
                 }
 
-                if (exit_dir != 0xFF) {
+                if (exit_dir != DIR_NONE) {
                     string_pos++;
                     sendHandover(exit_dir);
                     return;
@@ -322,13 +388,13 @@ void processChunk(char* data, uint16_t len) {
                 float new_x = t_x + dx;
                 float new_y = t_y + dy;
 
-                uint8_t exit_dir = 0xFF;
+                uint8_t exit_dir = DIR_NONE;
                 if (new_x < area_x_min) exit_dir = DIR_WEST;
                 else if (new_x >= area_x_max) exit_dir = DIR_EAST;
                 else if (new_y < area_y_min) exit_dir = DIR_SOUTH;
                 else if (new_y >= area_y_max) exit_dir = DIR_NORTH;
 
-                if (exit_dir != 0xFF) {
+                if (exit_dir != DIR_NONE) {
                     string_pos++;
                     sendHandover(exit_dir);
                     return;
@@ -396,6 +462,9 @@ void setup() {
     Serial.println(F("=== L-System Node Starting ==="));
 
     clearBitmap();
+    for (uint8_t dir = 0; dir < DIR_COUNT; dir++) {
+        neighbours[dir].node_id = NODE_ID_NONE;
+    }
 
     ZsutEthernet.begin(mac);
     Serial.print(F("My IP: "));
@@ -409,20 +478,24 @@ void setup() {
 
 unsigned long lastRegisterTime = 0;
 const unsigned long REGISTER_INTERVAL = 5000;
+unsigned long lastHeartbeatTime = 0;
 
 void loop() {
+    unsigned long now = millis();
     if (!isConfigured) {
-        unsigned long now = millis();
         if (now - lastRegisterTime > REGISTER_INTERVAL) {
             sendRegister();
             lastRegisterTime = now;
         }
+    } else if (now - lastHeartbeatTime > ALP_HEARTBEAT_INTERVAL_MS) {
+        sendHeartbeat();
+        lastHeartbeatTime = now;
     }
     
     int packetSize = Udp.parsePacket();
     
     if (packetSize > 0) {
-        Udp.read(packetBuffer, MAX_PACKET_SIZE);
+        Udp.read(packetBuffer, sizeof(packetBuffer));
         
         ALPHeader *h = (ALPHeader *)packetBuffer;
         uint16_t len = my_ntohs(h->length);
@@ -438,6 +511,8 @@ void loop() {
                 area_x_max = my_ntohs(cfg->x_max);
                 area_y_min = my_ntohs(cfg->y_min);
                 area_y_max = my_ntohs(cfg->y_max);
+                memcpy(neighbours, cfg->neighbours, sizeof(neighbours));
+                configEpoch = my_ntohs(cfg->epoch);
                 
                 isConfigured = true;
                 
@@ -449,6 +524,12 @@ void loop() {
                 Serial.print(F(" - ")); Serial.println(area_x_max);
                 Serial.print(F("Y: ")); Serial.print(area_y_min); 
                 Serial.print(F(" - ")); Serial.println(area_y_max);
+                Serial.print(F("Neighbours N/E/S/W: "));
+                for (uint8_t dir = 0; dir < DIR_COUNT; dir++) {
+                    Serial.print(neighbours[dir].node_id);
+                    Serial.print(F(" "));
+                }
+                Serial.println();
                 break;
             }
 
@@ -478,18 +559,31 @@ void loop() {
             case MSG_HANDOVER: {
                 PayloadHandover *ho = (PayloadHandover *)payload;
                 
+                if (!isTrustedSender()) {
+                    Serial.println(F("[WARN] Handover from unknown sender, ignoring."));
+                    break;
+                }
+                
                 if (ho->target_node_id != myNodeId && ho->target_node_id != 0xFF) {
                     Serial.println(F("[INFO] Handover not for me, ignoring."));
                     break;
                 }
+                
+                // Stos większy niż nasz (lub ucięty pakiet) - odrzucamy, zanim zmienimy stan żółwia
+                uint16_t recv_depth = my_ntohs(ho->stack_depth);
+                if (recv_depth > MAX_STACK_DEPTH ||
+                    len < sizeof(PayloadHandover) + recv_depth * sizeof(TurtleStackItem)) {
+                    Serial.println(F("[WARN] Handover stack too deep, ignoring."));
+                    break;
+                }
 
                 t_x = my_ntohs(ho->current_x);
                 t_y = my_ntohs(ho->current_y);
                 t_angle = (int16_t)my_ntohs((uint16_t)ho->current_angle);
                 string_pos = my_ntohl(ho->string_pos);
-                stack_depth = my_ntohs(ho->stack_depth);
+                stack_depth = recv_depth;
 
-                if (stack_depth > 0 && stack_depth <= MAX_STACK_DEPTH) {
+                if (stack_depth > 0) {
                     TurtleStackItem *recvStack = (TurtleStackItem *)(payload + sizeof(PayloadHandover));
                     for (uint16_t i = 0; i < stack_depth; i++) {
                         stack[i].x = my_ntohs(recvStack[i].x);
@@ -539,6 +633,17 @@ void loop() {
                 break;
             }
             
+            case MSG_DONE: {
+                // Żółw skończył u innego węzła - wysyłamy to, co narysowaliśmy u siebie
+                if (!isConfigured || isFinished) break;
+                
+                Serial.println(F("[NODE] Render finished, uploading bitmap."));
+                isDrawing = false;
+                isFinished = true;
+                sendUpload();
+                break;
+            }
+            
             case MSG_ACK: {
                 PayloadAck *ack = (PayloadAck *)payload;
                 Serial.print(F("[ACK] type=")); Serial.print(ack->acked_msg_type);
@@ -549,6 +654,23 @@ void loop() {
             case MSG_ERROR: {
                 PayloadError *err = (PayloadError *)payload;
                 Serial.print(F("[ERROR] code=")); Serial.println(err->error_code);
+                
+                if (err->error_code == ERR_EVICTED && isConfigured) {
+                    // Serwer oddał nasz obszar innemu węzłowi - zgłaszamy się od nowa.
+                    // Najpierw wysyłamy to, co już narysowaliśmy, żeby nie przepadło.
+                    Serial.println(F("[NODE] Evicted by server, uploading and re-registering."));
+                    sendUpload();
+                    isConfigured = false;
+                    isDrawing = false;
+                    isFinished = false;
+                    myNodeId = 0xFF;
+                    stack_depth = 0;
+                    for (uint8_t dir = 0; dir < DIR_COUNT; dir++) {
+                        neighbours[dir].node_id = NODE_ID_NONE;
+                    }
+                    clearBitmap();
+                    lastRegisterTime = 0;
+                }
                 break;
             }
             
@@ -4,6 +4,7 @@
 #include <unistd.h>
 #include <arpa/inet.h>
 #include <sys/socket.h>
+#include <sys/time.h>
 #include <time.h>
 #include "alp.h"
 
@@ -15,6 +16,13 @@
 #define NODE_BITMAP_H 15     // Wysokość bitmapy węzła
 #define L_SYSTEM_MAX_LEN 100000
 
+// Elastyczne członkostwo
+#define MAX_SPARES 4         // Węzły zapasowe (zarejestrowane po zapełnieniu slotów)
+#define NODE_TIMEOUT_SEC 5   // Brak wiadomości od węzła -> uznany za martwy
+#define STALL_TIMEOUT_SEC 10 // Żółw bez postępu -> węzeł zawieszony/przeciążony
+#define SPARE_TIMEOUT_SEC 15 // Zapasowy ponawia REGISTER co 5 s
+#define SERVER_TICK_MS 500   // Timeout recvfrom - co tyle sprawdzamy liveness
+
 // Struktura L-systemu
 #define MAX_RULES 26         // A-Z
 #define MAX_RULE_LEN 256
@@ -36,20 +44,43 @@ typedef struct {
     struct sockaddr_in addr;
     uint16_t x_min, x_max;
     uint16_t y_min, y_max;
+    time_t last_seen;        // Ostatnia wiadomość od węzła (HEARTBEAT lub dowolna inna)
+    int has_evicted;         // Poprzedni (wyrzucony) właściciel slotu może jeszcze przysłać UPLOAD
+    struct sockaddr_in evicted_addr;
 } NodeInfo;
 
+// Węzeł zapasowy - czeka na zwolnienie slotu
+typedef struct {
+    int active;
+    struct sockaddr_in addr;
+    time_t last_seen;
+} SpareInfo;
+
 // Zmienne globalne
 int sockfd;
 NodeInfo nodes[MAX_NODES];
 int registered_count = 0;
+SpareInfo spares[MAX_SPARES];
+uint16_t membership_epoch = 0;  // Wersja CONFIG - rośnie przy każdej zmianie sąsiadów
 char l_system_string[L_SYSTEM_MAX_LEN];
 uint32_t l_system_len = 0;
 
 // Globalna bitmapa do składania
 char final_bitmap[CANVAS_HEIGHT][CANVAS_WIDTH];
 
+// Ostatni znany stan żółwia (punkt kontrolny do przekazania po awarii węzła)
+int render_started = 0;
+int render_finished = 0;
+int turtle_holder = -1;                  // Slot, który aktualnie ma żółwia
+uint8_t turtle_checkpoint[MAX_PACKET_SIZE]; // PayloadHandover
+uint16_t turtle_checkpoint_len = 0;
+uint32_t turtle_pos = 0;
+time_t turtle_progress_time = 0;         // Kiedy string_pos ostatnio wzrósł
+int turtle_nudged = 0;                   // Po zastoju punkt kontrolny wysłany ponownie do właściciela
+
 // Statystyki
 int total_handovers = 0;
+int nodes_failed = 0;
 int messages_sent = 0;
 int messages_received = 0;
 
@@ -215,6 +246,18 @@ int find_node_index(struct sockaddr_in *addr) {
     return -1;
 }
 
+// Znajdź slot, którego poprzedni (wyrzucony) właściciel ma ten adres
+int find_evicted_index(struct sockaddr_in *addr) {
+    for (int i = 0; i < registered_count; i++) {
+        if (nodes[i].has_evicted &&
+            nodes[i].evicted_addr.sin_addr.s_addr == addr->sin_addr.s_addr &&
+            nodes[i].evicted_addr.sin_port == addr->sin_port) {
+            return i;
+        }
+    }
+    return -1;
+}
+
 // Logika podziału ekranu (2x2)
 // Layout:
 //   Node 0 (TL) | Node 1 (TR)    <- y >= mid_y (góra)
@@ -239,6 +282,50 @@ void assign_region(int node_idx) {
            nodes[node_idx].y_min, nodes[node_idx].y_max);
 }
 
+// Sąsiad węzła w danym kierunku (układ 2x2), -1 jeśli krawędź płótna
+int neighbour_of(int node_idx, uint8_t dir) {
+    switch (dir) {
+        case DIR_NORTH:
+            return (node_idx == 2) ? 0 : (node_idx == 3) ? 1 : -1;
+        case DIR_SOUTH:
+            return (node_idx == 0) ? 2 : (node_idx == 1) ? 3 : -1;
+        case DIR_EAST:
+            return (node_idx == 0) ? 1 : (node_idx == 2) ? 3 : -1;
+        case DIR_WEST:
+            return (node_idx == 1) ? 0 : (node_idx == 3) ? 2 : -1;
+    }
+    return -1;
+}
+
+// Wyślij CONFIG (obszar + adresy znanych sąsiadów) do węzła
+void send_config(int node_idx) {
+    PayloadConfig cfg;
+    cfg.node_id = node_idx;
+    cfg.step_size = 2;
+    cfg.angle = htons(lsystem.angle);  // Kąt z pliku L-systemu
+    cfg.x_min = htons(nodes[node_idx].x_min);
+    cfg.x_max = htons(nodes[node_idx].x_max);
+    cfg.y_min = htons(nodes[node_idx].y_min);
+    cfg.y_max = htons(nodes[node_idx].y_max);
+
+    for (uint8_t dir = 0; dir < DIR_COUNT; dir++) {
+        NeighbourInfo *nb = &cfg.neighbours[dir];
+        int nb_idx = neighbour_of(node_idx, dir);
+
+        memset(nb, 0, sizeof(*nb));
+        nb->node_id = NODE_ID_NONE;
+        if (nb_idx == -1 || !nodes[nb_idx].active) continue;
+
+        nb->node_id = nb_idx;
+        memcpy(nb->ip, &nodes[nb_idx].addr.sin_addr.s_addr, 4);
+        nb->port = nodes[nb_idx].addr.sin_port;  // Już w NETWORK BYTE ORDER
+    }
+    cfg.epoch = htons(membership_epoch);
+
+    send_alp_packet(&nodes[node_idx].addr, MSG_CONFIG, &cfg, sizeof(cfg));
+    printf("[SERVER] Sent CONFIG to Node %d\n", node_idx);
+}
+
 // Wyświetl złożoną bitmapę ASCII
 void print_final_bitmap() {
     printf("\n========== FINAL RENDER ==========\n");
@@ -256,6 +343,8 @@ void print_final_bitmap() {
 void check_completion() {
     int all_done = 1;
     for (int i = 0; i < registered_count; i++) {
+        // Martwy węzeł bez zastępstwa nie blokuje zakończenia (jego obszar zostaje pusty)
+        if (!nodes[i].active) continue;
         if (nodes[i].fragments_received < nodes[i].total_fragments) {
             all_done = 0;
             break;
@@ -265,11 +354,273 @@ void check_completion() {
     if (all_done && registered_count == MAX_NODES) {
         printf("\n[SERVER] All nodes finished!\n");
         printf("[STATS] Total handovers: %d\n", total_handovers);
+        printf("[STATS] Failed nodes: %d\n", nodes_failed);
         printf("[STATS] Messages sent: %d, received: %d\n", messages_sent, messages_received);
         print_final_bitmap();
     }
 }
 
+// Render zakończony - bitmapę wysyła tylko węzeł, u którego skończył się string,
+// więc prosimy o nią wszystkie pozostałe (DONE bez payloadu)
+void request_uploads() {
+    for (int i = 0; i < registered_count; i++) {
+        if (nodes[i].active && nodes[i].fragments_received == 0) {
+            send_alp_packet(&nodes[i].addr, MSG_DONE, NULL, 0);
+        }
+    }
+}
+
+// Wyślij CONFIG do wszystkich aktywnych węzłów (np. po zmianie adresu sąsiada)
+void send_config_all() {
+    for (int i = 0; i < registered_count; i++) {
+        if (nodes[i].active) {
+            send_config(i);
+        }
+    }
+}
+
+// Zajmij slot (nowy węzeł lub zastępstwo za martwy)
+void assign_slot(int node_idx, struct sockaddr_in *addr) {
+    nodes[node_idx].active = 1;
+    nodes[node_idx].finished = 0;
+    nodes[node_idx].fragments_received = 0;
+    // Oblicz oczekiwaną liczbę fragmentów na podstawie znanego rozmiaru
+    // Node wysyła 20x15 bitmap, bufor 256B, max 243B na piksele
+    // 243 / 20 = 12 wierszy na fragment
+    // ceil(15 / 12) = 2 fragmenty
+    nodes[node_idx].total_fragments = (NODE_BITMAP_H + 11) / 12;  // = 2
+    nodes[node_idx].id = node_idx;
+    nodes[node_idx].addr = *addr;
+    nodes[node_idx].last_seen = time(NULL);
+    assign_region(node_idx);
+    
+    printf("[SERVER] Node %d expected fragments: %d\n", 
+           node_idx, nodes[node_idx].total_fragments);
+}
+
+// Zapamiętaj węzeł zapasowy (lub odśwież istniejący). Zwraca -1 gdy brak miejsca.
+int add_spare(struct sockaddr_in *addr) {
+    int free_idx = -1;
+    for (int i = 0; i < MAX_SPARES; i++) {
+        if (spares[i].active &&
+            spares[i].addr.sin_addr.s_addr == addr->sin_addr.s_addr &&
+            spares[i].addr.sin_port == addr->sin_port) {
+            spares[i].last_seen = time(NULL);
+            return i;
+        }
+        if (!spares[i].active && free_idx == -1) free_idx = i;
+    }
+    
+    if (free_idx == -1) return -1;
+    
+    spares[free_idx].active = 1;
+    spares[free_idx].addr = *addr;
+    spares[free_idx].last_seen = time(NULL);
+    printf("[SERVER] Spare node registered (%s:%d)\n",
+           inet_ntoa(addr->sin_addr), ntohs(addr->sin_port));
+    return free_idx;
+}
+
+// Zapisz punkt kontrolny żółwia. Starsze stany (mniejszy string_pos) są pomijane -
+// chronią przed spóźnionym HEARTBEAT od węzła, który już oddał żółwia.
+void record_turtle(int holder, uint8_t *state, uint16_t len) {
+    if (len < sizeof(PayloadHandover) || len > sizeof(turtle_checkpoint)) return;
+    // Stos musi się zmieścić w pakiecie - inaczej węzeł odrzuci wznowienie z tego punktu
+    if (len < sizeof(PayloadHandover) +
+              ntohs(((PayloadHandover *)state)->stack_depth) * sizeof(TurtleStackItem)) return;
+    
+    uint32_t pos = ntohl(((PayloadHandover *)state)->string_pos);
+    if (turtle_holder != -1 && pos < turtle_pos) return;
+    
+    if (pos > turtle_pos || holder != turtle_holder) {
+        turtle_progress_time = time(NULL);
+        turtle_nudged = 0;
+    }
+    turtle_holder = holder;
+    turtle_pos = pos;
+    memcpy(turtle_checkpoint, state, len);
+    turtle_checkpoint_len = len;
+}
+
+// Przekaż żółwia (z punktu kontrolnego) węzłowi w slocie
+void resume_turtle(int node_idx) {
+    PayloadHandover *ho = (PayloadHandover *)turtle_checkpoint;
+    ho->target_node_id = node_idx;
+    turtle_progress_time = time(NULL);
+    turtle_nudged = 0;
+    
+    send_alp_packet(&nodes[node_idx].addr, MSG_HANDOVER, turtle_checkpoint, turtle_checkpoint_len);
+    printf("[SERVER] Resumed turtle on Node %d from checkpoint (Pos: %u)\n", 
+           node_idx, turtle_pos);
+}
+
+// Usuń węzeł (awaria lub zawieszenie) i oddaj jego obszar + żółwia zapasowemu.
+// Bez zapasowego obszar czeka na pierwszy nowy REGISTER.
+// Wyrzucony węzeł (jeśli żyje) wysyła jeszcze swoją bitmapę - przyjmujemy ją dla tego slotu.
+void fail_node(int node_idx, const char *reason) {
+    nodes[node_idx].active = 0;
+    nodes[node_idx].has_evicted = 1;
+    nodes[node_idx].evicted_addr = nodes[node_idx].addr;
+    nodes_failed++;
+    membership_epoch++;
+    printf("[SERVER] Node %d failed (%s), epoch now %u\n", node_idx, reason, membership_epoch);
+    
+    // Gdyby jednak żył (zawieszony) - niech przestanie rysować, wyśle bitmapę i zgłosi się od nowa
+    PayloadError err;
+    err.error_code = ERR_EVICTED;
+    send_alp_packet(&nodes[node_idx].addr, MSG_ERROR, &err, sizeof(err));
+    
+    time_t now = time(NULL);
+    for (int i = 0; i < MAX_SPARES; i++) {
+        if (!spares[i].active) continue;
+        spares[i].active = 0;
+        if (now - spares[i].last_seen > SPARE_TIMEOUT_SEC) continue;
+        
+        printf("[SERVER] Spare takes over region of Node %d\n", node_idx);
+        assign_slot(node_idx, &spares[i].addr);
+        break;
+    }
+    
+    // Sąsiedzi muszą poznać nowy adres (albo brak sąsiada -> HANDOVER przez serwer)
+    send_config_all();
+    
+    if (!nodes[node_idx].active) {
+        printf("[SERVER] Region of Node %d waiting for a new node\n", node_idx);
+        // Pozostałe węzły mogły już wszystko przesłać - pusty slot nie blokuje końca
+        check_completion();
+    } else if (turtle_holder == node_idx && !render_finished) {
+        resume_turtle(node_idx);
+    }
+}
+
+// Wykryj martwe (brak wiadomości) i zawieszone (żółw bez postępu) węzły
+void check_liveness() {
+    time_t now = time(NULL);
+    
+    for (int i = 0; i < registered_count; i++) {
+        if (nodes[i].active && now - nodes[i].last_seen > NODE_TIMEOUT_SEC) {
+            fail_node(i, "heartbeat timeout");
+        }
+    }
+    
+    if (render_started && !render_finished && turtle_holder != -1 &&
+        nodes[turtle_holder].active && now - turtle_progress_time > STALL_TIMEOUT_SEC) {
+        if (!turtle_nudged) {
+            // Zwykle to zgubiony STRING_CHUNK/REQUEST_CHUNK - wznów od punktu kontrolnego
+            printf("[SERVER] Turtle stalled on Node %d, re-sending checkpoint\n", turtle_holder);
+            resume_turtle(turtle_holder);
+            turtle_nudged = 1;
+        } else {
+            fail_node(turtle_holder, "turtle stalled");
+        }
+    }
+    
+    for (int i = 0; i < MAX_SPARES; i++) {
+        if (spares[i].active && now - spares[i].last_seen > SPARE_TIMEOUT_SEC) {
+            spares[i].active = 0;
+        }
+    }
+}
+
+// Obsłuż REQUEST_CHUNK: zbuduj i wyślij STRING_CHUNK od żądanej pozycji
+void handle_request_chunk(int node_idx, struct sockaddr_in *addr, uint8_t *payload_ptr) {
+    PayloadRequestChunk *req = (PayloadRequestChunk *)payload_ptr;
+    uint32_t offset = ntohl(req->offset);
+    uint16_t req_len = ntohs(req->max_len);
+
+    uint8_t chunk_buf[MAX_PACKET_SIZE];
+    PayloadStringChunk *chunk = (PayloadStringChunk *)chunk_buf;
+    
+    if (offset >= l_system_len) {
+        chunk->offset = htonl(offset);
+        chunk->data_len = htons(0);
+        chunk->total_len = htonl(l_system_len);
+        send_alp_packet(addr, MSG_STRING_CHUNK, chunk, sizeof(PayloadStringChunk));
+        printf("[SERVER] Sent empty chunk to Node %d (end of string)\n", node_idx);
+        return;
+    }
+
+    uint16_t actual_len = req_len;
+    if (offset + actual_len > l_system_len) {
+        actual_len = l_system_len - offset;
+    }
+    
+    if (actual_len > MAX_PACKET_SIZE - sizeof(ALPHeader) - sizeof(PayloadStringChunk)) {
+        actual_len = MAX_PACKET_SIZE - sizeof(ALPHeader) - sizeof(PayloadStringChunk);
+    }
+
+    chunk->offset = htonl(offset);
+    chunk->data_len = htons(actual_len);
+    chunk->total_len = htonl(l_system_len);
+    
+    if (actual_len > 0) {
+        memcpy(chunk->data, &l_system_string[offset], actual_len);
+    }
+
+    send_alp_packet(addr, MSG_STRING_CHUNK, chunk, 
+                   sizeof(PayloadStringChunk) + actual_len);
+    
+    if (offset % 1000 == 0 || offset + actual_len >= l_system_len) {
+        printf("[SERVER] Sent chunk to Node %d: offset=%u, len=%u/%u\n", 
+               node_idx, offset, actual_len, l_system_len);
+    }
+}
+
+// Wstaw fragment bitmapy węzła (obszar slotu node_idx) do globalnej bitmapy
+void composite_upload(int node_idx, PayloadUpload *up) {
+    uint8_t total_width = up->total_width;
+    uint16_t row_start = ntohs(up->row_start);
+    uint16_t row_count = ntohs(up->row_count);
+    uint16_t base_x = nodes[node_idx].x_min;
+    uint16_t base_y = nodes[node_idx].y_min;
+    
+    for (uint16_t y = 0; y < row_count; y++) {
+        uint16_t global_y = base_y + row_start + y;
+        if (global_y >= CANVAS_HEIGHT) continue;
+        
+        for (uint16_t x = 0; x < total_width; x++) {
+            uint16_t global_x = base_x + x;
+            if (global_x >= CANVAS_WIDTH) continue;
+            
+            char pixel = up->pixels[y * total_width + x];
+            if (pixel != ' ') {
+                final_bitmap[global_y][global_x] = pixel;
+            }
+        }
+    }
+}
+
+// Obsłuż UPLOAD: wstaw fragment bitmapy węzła do globalnej bitmapy
+void handle_upload(int node_idx, uint8_t *payload_ptr) {
+    PayloadUpload *up = (PayloadUpload *)payload_ptr;
+    uint8_t total_width = up->total_width;
+    uint8_t total_height = up->total_height;
+    uint8_t fragment_id = up->fragment_id;
+    uint8_t total_fragments = up->total_fragments;
+    uint16_t row_start = ntohs(up->row_start);
+    uint16_t row_count = ntohs(up->row_count);
+    
+    printf("[SERVER] UPLOAD from Node %d: fragment %d/%d, rows %d-%d (%dx%d total)\n", 
+           node_idx, fragment_id + 1, total_fragments, 
+           row_start, row_start + row_count - 1,
+           total_width, total_height);
+    
+    // Zapisz oczekiwaną liczbę fragmentów
+    if (nodes[node_idx].total_fragments == 0) {
+        nodes[node_idx].total_fragments = total_fragments;
+    }
+    
+    // Wstaw fragment bitmapy do globalnej bitmapy
+    composite_upload(node_idx, up);
+    
+    nodes[node_idx].fragments_received++;
+    
+    printf("[SERVER] Node %d: received %d/%d fragments\n",
+           node_idx, nodes[node_idx].fragments_received, nodes[node_idx].total_fragments);
+    
+    check_completion();
+}
+
 int main(int argc, char *argv[]) {
     struct sockaddr_in server_addr, client_addr;
     uint8_t buffer[MAX_PACKET_SIZE];
@@ -317,6 +668,12 @@ int main(int argc, char *argv[]) {
         exit(EXIT_FAILURE);
     }
 
+    // Okresowy powrót z recvfrom - wykrywanie awarii działa też bez ruchu w sieci
+    struct timeval tick;
+    tick.tv_sec = 0;
+    tick.tv_usec = SERVER_TICK_MS * 1000;
+    setsockopt(sockfd, SOL_SOCKET, SO_RCVTIMEO, &tick, sizeof(tick));
+
     printf("[SERVER] Listening on port %d...\n", ALP_SERVER_PORT);
     printf("[SERVER] Canvas size: %dx%d\n", CANVAS_WIDTH, CANVAS_HEIGHT);
 
@@ -325,6 +682,8 @@ int main(int argc, char *argv[]) {
         ssize_t n = recvfrom(sockfd, buffer, MAX_PACKET_SIZE, 0, 
                              (struct sockaddr *)&client_addr, &addr_len);
         
+        check_liveness();
+        
         if (n < (ssize_t)sizeof(ALPHeader)) continue;
 
         messages_received++;
@@ -334,49 +693,69 @@ int main(int argc, char *argv[]) {
         uint8_t *payload_ptr = buffer + sizeof(ALPHeader);
 
         int node_idx = find_node_index(&client_addr);
+        if (node_idx != -1) {
+            nodes[node_idx].last_seen = time(NULL);
+        }
 
         switch (header->type) {
             case MSG_REGISTER: {
-                if (registered_count >= MAX_NODES) {
-                    printf("[WARN] Ignored REGISTER: Max nodes reached.\n");
+                if (node_idx != -1) {
+                    // Powtórzony REGISTER (zgubiony CONFIG) - wyślij ponownie
+                    send_config(node_idx);
                     break;
                 }
                 
-                if (node_idx == -1) {
+                if (registered_count < MAX_NODES) {
                     node_idx = registered_count++;
-                    nodes[node_idx].active = 1;
-                    nodes[node_idx].finished = 0;
-                    nodes[node_idx].fragments_received = 0;
-                    // Oblicz oczekiwaną liczbę fragmentów na podstawie znanego rozmiaru
-                    // Node wysyła 20x15 bitmap, bufor 256B, max 243B na piksele
-                    // 243 / 20 = 12 wierszy na fragment
-                    // ceil(15 / 12) = 2 fragmenty
-                    nodes[node_idx].total_fragments = (NODE_BITMAP_H + 11) / 12;  // = 2
-                    nodes[node_idx].id = node_idx;
-                    nodes[node_idx].addr = client_addr;
-                    assign_region(node_idx);
+                    assign_slot(node_idx, &client_addr);
+                } else {
+                    // Wszystkie sloty zajęte - przejmij obszar martwego węzła albo czekaj jako zapasowy.
+                    // Najpierw obszar, w którym czeka żółw - inaczej render dalej stoi.
+                    if (render_started && !render_finished && turtle_holder != -1 &&
+                        !nodes[turtle_holder].active) {
+                        node_idx = turtle_holder;
+                    }
+                    for (int i = 0; i < registered_count && node_idx == -1; i++) {
+                        if (!nodes[i].active) {
+                            node_idx = i;
+                        }
+                    }
+                    
+                    if (node_idx == -1) {
+                        if (add_spare(&client_addr) == -1) {
+                            printf("[WARN] Ignored REGISTER: Max nodes and spares reached.\n");
+                        }
+                        break;
+                    }
                     
-                    printf("[SERVER] Node %d expected fragments: %d\n", 
-                           node_idx, nodes[node_idx].total_fragments);
+                    printf("[SERVER] Late node takes over region of Node %d\n", node_idx);
+                    assign_slot(node_idx, &client_addr);
+                    
+                    if (render_started) {
+                        membership_epoch++;
+                        send_config_all();
+                        if (turtle_holder == node_idx && !render_finished) {
+                            resume_turtle(node_idx);
+                        }
+                        break;
+                    }
                 }
 
-                // Wyślij CONFIG
-                PayloadConfig cfg;
-                cfg.node_id = node_idx;
-                cfg.step_size = 2;
-                cfg.angle = htons(lsystem.angle);  // Kąt z pliku L-systemu
-                cfg.x_min = htons(nodes[node_idx].x_min);
-                cfg.x_max = htons(nodes[node_idx].x_max);
-                cfg.y_min = htons(nodes[node_idx].y_min);
-                cfg.y_max = htons(nodes[node_idx].y_max);
+                int all_registered = (registered_count == MAX_NODES && !render_started);
 
-                send_alp_packet(&client_addr, MSG_CONFIG, &cfg, sizeof(cfg));
-                printf("[SERVER] Sent CONFIG to Node %d\n", node_idx);
+                // Wyślij CONFIG (ostatni węzeł dostanie go niżej, razem z pozostałymi)
+                if (!all_registered) {
+                    send_config(node_idx);
+                }
 
                 // Jeśli wszystkie węzły zarejestrowane, wyślij START do Node 2
-                if (registered_count == MAX_NODES) {
+                if (all_registered) {
                     printf("[SERVER] All %d nodes registered. Starting render...\n", MAX_NODES);
                     
+                    // CONFIG z pełną tablicą sąsiadów (HANDOVER bez pośrednictwa serwera)
+                    membership_epoch++;
+                    send_config_all();
+                    
                     int start_node = 2;
                     PayloadStart start;
                     start.start_x = htons(nodes[start_node].x_min + 5);
@@ -384,9 +763,27 @@ int main(int argc, char *argv[]) {
                     start.start_angle = htons(0);
                     start.string_pos = htonl(0);
                     
-                    send_alp_packet(&nodes[start_node].addr, MSG_START, &start, sizeof(start));
-                    printf("[SERVER] Sent START to Node %d at position (%d, %d)\n", 
-                           start_node, nodes[start_node].x_min + 5, nodes[start_node].y_min + 5);
+                    if (nodes[start_node].active) {
+                        send_alp_packet(&nodes[start_node].addr, MSG_START, &start, sizeof(start));
+                        printf("[SERVER] Sent START to Node %d at position (%d, %d)\n", 
+                               start_node, nodes[start_node].x_min + 5, nodes[start_node].y_min + 5);
+                    } else {
+                        // Punkt kontrolny poniżej - żółw ruszy, gdy ktoś przejmie ten obszar
+                        printf("[SERVER] Node %d is down, START parked until a node takes over\n",
+                               start_node);
+                    }
+                    
+                    // Pierwszy punkt kontrolny = stan startowy
+                    PayloadHandover initial;
+                    memset(&initial, 0, sizeof(initial));
+                    initial.target_node_id = start_node;
+                    initial.exit_dir = DIR_NONE;
+                    initial.string_pos = start.string_pos;
+                    initial.current_x = start.start_x;
+                    initial.current_y = start.start_y;
+                    initial.current_angle = start.start_angle;
+                    record_turtle(start_node, (uint8_t *)&initial, sizeof(initial));
+                    render_started = 1;
                 }
                 break;
             }
@@ -394,69 +791,17 @@ int main(int argc, char *argv[]) {
             case MSG_REQUEST_CHUNK: {
                 if (node_idx == -1) break;
                 
-                PayloadRequestChunk *req = (PayloadRequestChunk *)payload_ptr;
-                uint32_t offset = ntohl(req->offset);
-                uint16_t req_len = ntohs(req->max_len);
-
-                uint8_t chunk_buf[MAX_PACKET_SIZE];
-                PayloadStringChunk *chunk = (PayloadStringChunk *)chunk_buf;
-                
-                if (offset >= l_system_len) {
-                    chunk->offset = htonl(offset);
-                    chunk->data_len = htons(0);
-                    chunk->total_len = htonl(l_system_len);
-                    send_alp_packet(&client_addr, MSG_STRING_CHUNK, chunk, sizeof(PayloadStringChunk));
-                    printf("[SERVER] Sent empty chunk to Node %d (end of string)\n", node_idx);
-                    break;
-                }
-
-                uint16_t actual_len = req_len;
-                if (offset + actual_len > l_system_len) {
-                    actual_len = l_system_len - offset;
-                }
-                
-                if (actual_len > MAX_PACKET_SIZE - sizeof(ALPHeader) - sizeof(PayloadStringChunk)) {
-                    actual_len = MAX_PACKET_SIZE - sizeof(ALPHeader) - sizeof(PayloadStringChunk);
-                }
-
-                chunk->offset = htonl(offset);
-                chunk->data_len = htons(actual_len);
-                chunk->total_len = htonl(l_system_len);
-                
-                if (actual_len > 0) {
-                    memcpy(chunk->data, &l_system_string[offset], actual_len);
-                }
-
-                send_alp_packet(&client_addr, MSG_STRING_CHUNK, chunk, 
-                               sizeof(PayloadStringChunk) + actual_len);
-                
-                if (offset % 1000 == 0 || offset + actual_len >= l_system_len) {
-                    printf("[SERVER] Sent chunk to Node %d: offset=%u, len=%u/%u\n", 
-                           node_idx, offset, actual_len, l_system_len);
-                }
+                handle_request_chunk(node_idx, &client_addr, payload_ptr);
                 break;
             }
 
             case MSG_HANDOVER: {
+                if (node_idx == -1) break;  // Np. wyrzucony węzeł - jego żółw jest nieaktualny
+                
                 PayloadHandover *ho = (PayloadHandover *)payload_ptr;
                 uint8_t exit_dir = ho->exit_dir;
                 int source_id = node_idx;
-                int target_id = -1;
-
-                switch (exit_dir) {
-                    case DIR_NORTH:
-                        target_id = (source_id == 2) ? 0 : (source_id == 3) ? 1 : -1;
-                        break;
-                    case DIR_SOUTH:
-                        target_id = (source_id == 0) ? 2 : (source_id == 1) ? 3 : -1;
-                        break;
-                    case DIR_EAST:
-                        target_id = (source_id == 0) ? 1 : (source_id == 2) ? 3 : -1;
-                        break;
-                    case DIR_WEST:
-                        target_id = (source_id == 1) ? 0 : (source_id == 3) ? 2 : -1;
-                        break;
-                }
+                int target_id = neighbour_of(source_id, exit_dir);
 
                 if (target_id != -1 && nodes[target_id].active) {
                     total_handovers++;
@@ -466,10 +811,62 @@ int main(int argc, char *argv[]) {
                     ho->target_node_id = target_id;
                     
                     send_alp_packet(&nodes[target_id].addr, MSG_HANDOVER, payload_ptr, payload_len);
+                    record_turtle(target_id, payload_ptr, payload_len);
+                } else if (target_id != -1) {
+                    // Sąsiad martwy, brak zastępstwa - żółw czeka na nowy węzeł w tym obszarze
+                    total_handovers++;
+                    ho->target_node_id = target_id;
+                    record_turtle(target_id, payload_ptr, payload_len);
+                    printf("[SERVER] HANDOVER #%d: Node %d -> Node %d parked (target down, Pos: %u)\n", 
+                           total_handovers, source_id, target_id, ntohl(ho->string_pos));
                 } else {
                     printf("[SERVER] Turtle exited canvas bounds (Source: %d, Dir: %d). Marking as done.\n", 
                            source_id, exit_dir);
                     nodes[source_id].finished = 1;
+                    render_finished = 1;
+                    request_uploads();
+                }
+                break;
+            }
+            
+            case MSG_HANDOVER_NOTIFY: {
+                // Węzeł przekazał żółwia bezpośrednio sąsiadowi - tylko księgowanie
+                if (node_idx == -1) break;
+                
+                PayloadHandover *ho = (PayloadHandover *)payload_ptr;
+                total_handovers++;
+                printf("[SERVER] HANDOVER #%d (direct): Node %d -> Node %d (Dir: %d, Pos: %u)\n", 
+                       total_handovers, node_idx, ho->target_node_id, ho->exit_dir, ntohl(ho->string_pos));
+                
+                if (ho->target_node_id < MAX_NODES) {
+                    record_turtle(ho->target_node_id, payload_ptr, payload_len);
+                }
+                break;
+            }
+            
+            case MSG_HEARTBEAT: {
+                if (node_idx == -1) {
+                    // Węzeł uznany za martwy wrócił - niech zarejestruje się od nowa
+                    PayloadError err;
+                    err.error_code = ERR_EVICTED;
+                    send_alp_packet(&client_addr, MSG_ERROR, &err, sizeof(err));
+                    break;
+                }
+                
+                if (payload_len < sizeof(PayloadHeartbeat)) break;
+                
+                PayloadHeartbeat *hb = (PayloadHeartbeat *)payload_ptr;
+                if (ntohs(hb->epoch) != membership_epoch) {
+                    // Węzeł zgubił CONFIG - bez niego ma nieaktualnych sąsiadów
+                    send_config(node_idx);
+                }
+                
+                if (render_finished && hb->state != NODE_STATE_FINISHED) {
+                    // Zgubiony DONE albo węzeł dołączył po końcu renderu - poproś o bitmapę ponownie
+                    send_alp_packet(&nodes[node_idx].addr, MSG_DONE, NULL, 0);
+                } else if (hb->state == NODE_STATE_DRAWING) {
+                    record_turtle(node_idx, payload_ptr + sizeof(PayloadHeartbeat),
+                                  payload_len - sizeof(PayloadHeartbeat));
                 }
                 break;
             }
@@ -479,57 +876,25 @@ int main(int argc, char *argv[]) {
                 
                 PayloadDone *done = (PayloadDone *)payload_ptr;
                 nodes[node_idx].finished = 1;
+                render_finished = 1;
                 printf("[SERVER] Node %d finished. Total steps: %u\n", 
                        node_idx, ntohl(done->total_steps));
+                request_uploads();
                 break;
             }
             
             case MSG_UPLOAD: {
-                if (node_idx == -1) break;
-                
-                PayloadUpload *up = (PayloadUpload *)payload_ptr;
-                uint8_t total_width = up->total_width;
-                uint8_t total_height = up->total_height;
-                uint8_t fragment_id = up->fragment_id;
-                uint8_t total_fragments = up->total_fragments;
-                uint16_t row_start = ntohs(up->row_start);
-                uint16_t row_count = ntohs(up->row_count);
-                
-                printf("[SERVER] UPLOAD from Node %d: fragment %d/%d, rows %d-%d (%dx%d total)\n", 
-                       node_idx, fragment_id + 1, total_fragments, 
-                       row_start, row_start + row_count - 1,
-                       total_width, total_height);
-                
-                // Zapisz oczekiwaną liczbę fragmentów
-                if (nodes[node_idx].total_fragments == 0) {
-                    nodes[node_idx].total_fragments = total_fragments;
-                }
-                
-                // Wstaw fragment bitmapy do globalnej bitmapy
-                uint16_t base_x = nodes[node_idx].x_min;
-                uint16_t base_y = nodes[node_idx].y_min;
-                
-                for (uint16_t y = 0; y < row_count; y++) {
-                    uint16_t global_y = base_y + row_start + y;
-                    if (global_y >= CANVAS_HEIGHT) continue;
-                    
-                    for (uint16_t x = 0; x < total_width; x++) {
-                        uint16_t global_x = base_x + x;
-                        if (global_x >= CANVAS_WIDTH) continue;
-                        
-                        char pixel = up->pixels[y * total_width + x];
-                        if (pixel != ' ') {
-                            final_bitmap[global_y][global_x] = pixel;
-                        }
+                if (node_idx == -1) {
+                    // Bitmapa od wyrzuconego węzła - kreski z jego obszaru nie przepadają
+                    int evicted_idx = find_evicted_index(&client_addr);
+                    if (evicted_idx != -1) {
+                        composite_upload(evicted_idx, (PayloadUpload *)payload_ptr);
+                        printf("[SERVER] UPLOAD from evicted owner of Node %d merged\n", evicted_idx);
                     }
+                    break;
                 }
                 
-                nodes[node_idx].fragments_received++;
-                
-                printf("[SERVER] Node %d: received %d/%d fragments\n",
-                       node_idx, nodes[node_idx].fragments_received, nodes[node_idx].total_fragments);
-                
-                check_completion();
+                handle_upload(node_idx, payload_ptr);
                 break;
             }
             